@@ -12,7 +12,15 @@
 #include "pch.h"
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <xmmintrin.h>
 
 // Include Speedy/Sonic headers
 // Define KISS_FFT before including to use kiss_fft instead of FFTW
@@ -25,6 +33,39 @@ extern "C" {
 // Only the functions undef'd in sonic2.h use the regular names
 }
 
+#include "sample_convert.h"
+#include "resampler.h"
+#include "tension_estimator.h"
+
+// Sonic stream I/O for each internal precision
+template<typename T>
+struct sonic_io;
+
+template<>
+struct sonic_io<short> {
+    static int write(sonicStream stream, const short* samples, int frames) {
+        return sonicWriteShortToStream(stream, samples, frames);
+    }
+    static int read(sonicStream stream, short* samples, int max_frames) {
+        return sonicReadShortFromStream(stream, samples, max_frames);
+    }
+};
+
+template<>
+struct sonic_io<float> {
+    static int write(sonicStream stream, const float* samples, int frames) {
+        return sonicWriteFloatToStream(stream, samples, frames);
+    }
+    static int read(sonicStream stream, float* samples, int max_frames) {
+        return sonicReadFloatFromStream(stream, samples, max_frames);
+    }
+};
+
+// Precision handed to Sonic. Sonic keeps its buffers as 16-bit integers, so
+// short avoids a second conversion inside Sonic; float is supported for Sonic
+// builds that process in floating point.
+typedef short sonic_sample;
+
 // Component GUID - unique identifier for this DSP
 // {8E4A9F2C-3B5D-4E7A-9C1F-6D8B2A4E5F3C}
 static const GUID g_dsp_speedy_guid =
@@ -38,6 +79,92 @@ static const float kDefaultVolume = 1.0f;
 static const bool kDefaultNonlinear = false;
 static const float kDefaultNonlinearFactor = 1.0f;
 static const bool kDefaultPitchInSemitones = false;
+static const int kDefaultLatencyProfile = 1;  // Balanced
+
+// Amount of processed output kept from the start of the stream after a flush.
+// Covers Sonic's buffering and Speedy's lookahead so a repeated loop start
+// plays processed audio immediately.
+static const double kSnapshotSeconds = 0.5;
+
+// A seek point is identified by a hash of its first 100 ms of input. Points
+// whose first 100 ms peak below about -60 dBFS are never cached: digital
+// silence or near-silence looks the same at many points of a track.
+static const double kFingerprintSeconds = 0.1;
+static const double kFingerprintFloor = 0.001;
+
+// Frames per processing block. Conversion, Sonic and conversion back run on
+// one block at a time so large chunks are not streamed through memory once
+// per stage; 1024 stereo frames keep all stages' buffers within L2. The
+// autotuner picks the best of the candidates for the machine's caches.
+static const t_size kProcessBlockFrames = 1024;
+static const t_size kBlockFrameCandidates[] = { 256, 512, 1024, 2048, 4096 };
+static const int kBlockFrameCandidateCount = sizeof(kBlockFrameCandidates) / sizeof(kBlockFrameCandidates[0]);
+
+// Smallest block handed to the engine. Smaller chunks are collected first so
+// the fixed cost of a Sonic write and read is not paid for a few hundred
+// frames that Sonic mostly just buffers.
+static const t_size kMinProcessFrames = 512;
+
+// Seek snapshot cache budgets selectable in the dialog (MB, 0 = off)
+static const int kSeekCacheSizes[] = { 0, 4, 16, 64 };
+static const int kSeekCacheSizeCount = sizeof(kSeekCacheSizes) / sizeof(kSeekCacheSizes[0]);
+static const int kDefaultSeekCacheSize = 0;  // Off
+
+// Speech-bandwidth mode internal rates selectable in the dialog (Hz, 0 = off).
+// Input above the selected rate is band-limited and downsampled, stretched at
+// that rate, and upsampled back to the chunk's rate.
+static const unsigned kSpeechBandRates[] = { 0, 16000, 24000, 32000 };
+static const int kSpeechBandRateCount = sizeof(kSpeechBandRates) / sizeof(kSpeechBandRates[0]);
+static const int kDefaultSpeechBand = 0;  // Off
+static const bool kDefaultLowPowerNonlinear = false;
+
+// Latency profiles
+// Speedy's temporal hysteresis (12 frames of lookahead) and its 10 ms analysis
+// hop are compile-time constants in speedy.c, and Sonic's maximum period window
+// is fixed by SONIC_MIN_PITCH. A profile therefore selects which of those
+// stages run and how Sonic searches for periods, and reports the latency that
+// combination actually has. No profile gets below Sonic's own buffering: Live
+// is the lowest latency Sonic allows, not a fixed target.
+enum {
+    kLatencyProfileLive = 0,
+    kLatencyProfileBalanced,
+    kLatencyProfileQuality,
+    kLatencyProfileCount
+};
+
+struct latency_profile_params {
+    const char* name;
+    int speedy_lookahead_frames;  // Speedy temporal hysteresis (0 = nonlinear disabled)
+    double speedy_frame_hop;      // Seconds per Speedy analysis frame
+    int sonic_quality;            // 0 = decimated period search, 1 = full-rate search
+};
+
+static const latency_profile_params kLatencyProfiles[kLatencyProfileCount] = {
+    { "Live",     0,  0.01, 0 },
+    { "Balanced", 12, 0.01, 0 },
+    { "Quality",  12, 0.01, 1 },
+};
+
+// Sonic produces no output until it holds maxRequired = 2 * rate /
+// SONIC_MIN_PITCH input frames (its longest period window), about 31 ms at
+// any sample rate
+static const double kSonicBufferingSeconds = 2.0 / SONIC_MIN_PITCH;
+
+static const latency_profile_params& get_latency_profile(int profile) {
+    if (profile < 0 || profile >= kLatencyProfileCount) {
+        profile = kDefaultLatencyProfile;
+    }
+    return kLatencyProfiles[profile];
+}
+
+// Total latency in seconds for a profile, with or without nonlinear speedup
+static double get_profile_latency(const latency_profile_params& profile, bool nonlinear) {
+    double latency = kSonicBufferingSeconds;
+    if (nonlinear) {
+        latency += profile.speedy_lookahead_frames * profile.speedy_frame_hop;
+    }
+    return latency;
+}
 
 // Semitone conversion utilities
 // Semitones to pitch ratio: ratio = 2^(semitones/12)
@@ -60,6 +187,10 @@ struct dsp_speedy_config {
     bool nonlinear_enabled;
     float nonlinear_factor;
     bool pitch_in_semitones;  // UI display mode
+    int latency_profile;
+    int seek_cache_size;  // Index into kSeekCacheSizes
+    int speech_band;      // Index into kSpeechBandRates
+    bool low_power_nonlinear;  // Time-domain tension estimator instead of Speedy
 
     dsp_speedy_config() :
         speed(kDefaultSpeed),
@@ -68,7 +199,11 @@ struct dsp_speedy_config {
         volume(kDefaultVolume),
         nonlinear_enabled(kDefaultNonlinear),
         nonlinear_factor(kDefaultNonlinearFactor),
-        pitch_in_semitones(kDefaultPitchInSemitones)
+        pitch_in_semitones(kDefaultPitchInSemitones),
+        latency_profile(kDefaultLatencyProfile),
+        seek_cache_size(kDefaultSeekCacheSize),
+        speech_band(kDefaultSpeechBand),
+        low_power_nonlinear(kDefaultLowPowerNonlinear)
     {}
 
     bool is_default() const {
@@ -82,25 +217,668 @@ struct dsp_speedy_config {
     void reset() {
         *this = dsp_speedy_config();
     }
+
+    // Rate Sonic runs at for a given input rate
+    unsigned get_stream_rate(unsigned sample_rate) const {
+        unsigned band_rate = 0;
+        if (speech_band > 0 && speech_band < kSpeechBandRateCount) {
+            band_rate = kSpeechBandRates[speech_band];
+        }
+        return (band_rate > 0 && band_rate < sample_rate) ? band_rate : sample_rate;
+    }
+
+    // Speedy needs its lookahead, which the live profile drops
+    bool use_speedy() const {
+        return nonlinear_enabled && !low_power_nonlinear &&
+               get_latency_profile(latency_profile).speedy_lookahead_frames > 0;
+    }
+
+    // The low-power estimator has no lookahead and works with every profile
+    bool use_low_power_nonlinear() const {
+        return nonlinear_enabled && low_power_nonlinear;
+    }
+};
+
+// 64-bit FNV-1a hash, used to key and verify seek snapshots
+static const t_uint64 kFnv1aBasis = 14695981039346656037ULL;
+
+static t_uint64 fnv1a_hash(const void* data, t_size size, t_uint64 hash = kFnv1aBasis) {
+    const t_uint8* bytes = static_cast<const t_uint8*>(data);
+    for (t_size i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Seek snapshot cache
+// Holds the output a fresh stream produced after a flush, keyed by track,
+// settings and a hash of the first kFingerprintSeconds of input, along with a
+// hash of all the input consumed to produce it. Shared by all DSP instances
+// and bounded by the byte budget of the most recent insert, evicting the least
+// recently used entries first.
+class seek_snapshot_cache {
+public:
+    struct key {
+        t_uint64 track;        // Hash of path and subsong (never 0)
+        t_uint64 settings;     // Hash of the preset data
+        t_uint64 fingerprint;  // Hash of the first kFingerprintSeconds of input
+        unsigned sample_rate;
+        unsigned channels;
+
+        bool operator==(const key& other) const {
+            return track == other.track && settings == other.settings &&
+                   fingerprint == other.fingerprint &&
+                   sample_rate == other.sample_rate && channels == other.channels;
+        }
+    };
+
+    struct snapshot {
+        std::vector<sonic_sample> output;
+        t_size input_frames;   // Input frames consumed to produce the output
+        t_uint64 input_hash;   // Hash of those input frames
+    };
+
+    typedef std::shared_ptr<const snapshot> snapshot_ptr;
+
+    snapshot_ptr lookup(const key& k) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->k == k) {
+                m_entries.splice(m_entries.begin(), m_entries, it);  // Mark most recently used
+                return m_entries.front().data;
+            }
+        }
+        return snapshot_ptr();
+    }
+
+    void store(const key& k, snapshot&& data, t_size budget_bytes) {
+        const t_size bytes = data.output.size() * sizeof(sonic_sample);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->k == k) {
+                m_bytes -= it->bytes;
+                m_entries.erase(it);
+                break;
+            }
+        }
+        if (bytes == 0 || bytes > budget_bytes) {
+            return;
+        }
+        while (!m_entries.empty() && m_bytes + bytes > budget_bytes) {
+            m_bytes -= m_entries.back().bytes;
+            m_entries.pop_back();
+        }
+        entry e;
+        e.k = k;
+        e.data = std::make_shared<const snapshot>(std::move(data));
+        e.bytes = bytes;
+        m_entries.push_front(std::move(e));
+        m_bytes += bytes;
+    }
+
+private:
+    struct entry {
+        key k;
+        snapshot_ptr data;
+        t_size bytes;
+    };
+
+    std::mutex m_mutex;
+    std::list<entry> m_entries;  // Front is most recently used
+    t_size m_bytes = 0;
+};
+
+static seek_snapshot_cache g_seek_cache;
+
+// Last input format seen by any instance, used to pre-warm new instances
+// {CF797F31-990D-4A14-8938-84A2C583D77F}
+static const GUID g_cfg_last_sample_rate_guid =
+{ 0xcf797f31, 0x990d, 0x4a14, { 0x89, 0x38, 0x84, 0xa2, 0xc5, 0x83, 0xd7, 0x7f } };
+// {041365E2-C332-4169-9895-433E9E59821A}
+static const GUID g_cfg_last_channels_guid =
+{ 0x041365e2, 0xc332, 0x4169, { 0x98, 0x95, 0x43, 0x3e, 0x9e, 0x59, 0x82, 0x1a } };
+
+static cfg_int g_cfg_last_sample_rate(g_cfg_last_sample_rate_guid, 0);
+static cfg_int g_cfg_last_channels(g_cfg_last_channels_guid, 0);
+
+// Create a Sonic stream with the given settings applied
+static sonicStream create_stream(const dsp_speedy_config& config, unsigned sample_rate, unsigned channels) {
+    sonicStream stream = sonicCreateStream(sample_rate, channels);
+    if (!stream) {
+        return nullptr;
+    }
+
+    // Apply settings
+    // sonicSetSpeed and sonicSetRate are wrapped by sonic2.h (call internal sonic)
+    // sonicSetPitch and sonicSetVolume are renamed to Int versions by SONIC_INTERNAL
+    sonicSetSpeed(stream, config.speed);
+    sonicIntSetPitch(stream, config.pitch);
+    sonicSetRate(stream, config.rate);
+    sonicIntSetVolume(stream, config.volume);
+    sonicIntSetQuality(stream, get_latency_profile(config.latency_profile).sonic_quality);
+
+    // Enable nonlinear speedup if requested and the latency profile allows it
+    if (config.use_speedy()) {
+        sonicEnableNonlinearSpeedup(stream, config.nonlinear_factor);
+    }
+
+    return stream;
+}
+
+// Deferred reclamation
+// Destroying a stream frees Sonic's buffers and Speedy's FFT state, and a
+// pre-warmed stream may still be under construction when it is discarded.
+// Streams retired on the playback thread are therefore queued and destroyed
+// by a worker thread; the playback thread only pushes a pointer.
+class stream_reclaimer {
+public:
+    stream_reclaimer() : m_running(false) {
+        // Room for a burst of retirements without allocating on the playback
+        // thread. The worker's own vectors get the same reserve, as they are
+        // swapped with these.
+        m_streams.reserve(kQueueReserve);
+        m_pending.reserve(kQueueReserve);
+    }
+
+    ~stream_reclaimer() {
+        // on_quit normally stopped the worker; never join under the loader lock
+        if (m_worker.joinable()) {
+            m_worker.detach();
+        }
+    }
+
+    void retire(sonicStream stream) {
+        if (!stream) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_running) {
+                m_streams.push_back(stream);
+                m_wake.notify_one();
+                return;
+            }
+        }
+        sonicDestroyStream(stream);
+    }
+
+    // Takes over a pre-warm that may still be running
+    void retire(std::future<sonicStream>&& pending) {
+        if (!pending.valid()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_running) {
+                m_pending.push_back(std::move(pending));
+                m_wake.notify_one();
+                return;
+            }
+        }
+        sonicStream stream = pending.get();
+        if (stream) {
+            sonicDestroyStream(stream);
+        }
+    }
+
+    // Starts the worker. Until then, and after shutdown(), retired streams
+    // are destroyed synchronously.
+    void start() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running && !m_worker.joinable()) {
+            m_running = true;
+            m_worker = std::thread(&stream_reclaimer::run, this);
+        }
+    }
+
+    // Frees everything still queued and stops the worker
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+            m_wake.notify_one();
+        }
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+private:
+    static const size_t kQueueReserve = 16;
+
+    void run() {
+        std::vector<sonicStream> streams;
+        std::vector<std::future<sonicStream> > pending;
+        streams.reserve(kQueueReserve);
+        pending.reserve(kQueueReserve);
+        for (;;) {
+            bool stopped;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this]() { return !m_running || !m_streams.empty() || !m_pending.empty(); });
+                streams.swap(m_streams);
+                pending.swap(m_pending);
+                stopped = !m_running;
+            }
+
+            for (size_t i = 0; i < pending.size(); i++) {
+                streams.push_back(pending[i].get());
+            }
+            pending.clear();
+            for (size_t i = 0; i < streams.size(); i++) {
+                if (streams[i]) {
+                    sonicDestroyStream(streams[i]);
+                }
+            }
+            streams.clear();
+
+            if (stopped) {
+                return;
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_worker;
+    std::vector<sonicStream> m_streams;
+    std::vector<std::future<sonicStream> > m_pending;
+    bool m_running;
+};
+
+static stream_reclaimer g_reclaimer;
+
+// Autotuning
+// The processing block size and the conversion kernel (scalar loop or
+// explicit SSE2) are measured once on this machine and build, and the
+// winners are kept in the configuration along with a stamp of the build that
+// measured them. There is no CPU feature dispatch: SSE2 against scalar is the
+// only kernel choice. The measurement runs on its own thread, and only while
+// nothing is playing so playback neither disturbs the timings nor competes
+// with them: it starts with the application if needed, is deferred while
+// playback runs, and is abandoned (to be retried at the next stop) if
+// playback starts meanwhile. Until there is a result, streams use
+// kProcessBlockFrames and the scalar conversion. The dialog's Re-tune
+// button measures again, and streams created afterwards use the new result.
+// {A1B878E1-DD7B-4B4E-99BD-16C49797B525}
+static const GUID g_cfg_tuned_block_frames_guid =
+{ 0xa1b878e1, 0xdd7b, 0x4b4e, { 0x99, 0xbd, 0x16, 0xc4, 0x97, 0x97, 0xb5, 0x25 } };
+// {5AC2E9F7-3FC2-469C-B857-04108109BD49}
+static const GUID g_cfg_tuned_simd_convert_guid =
+{ 0x5ac2e9f7, 0x3fc2, 0x469c, { 0xb8, 0x57, 0x04, 0x10, 0x81, 0x09, 0xbd, 0x49 } };
+
+// {FB5CB1B2-CC9D-445A-92A5-2512AE80E33A}
+static const GUID g_cfg_tuned_build_guid =
+{ 0xfb5cb1b2, 0xcc9d, 0x445a, { 0x92, 0xa5, 0x25, 0x12, 0xae, 0x80, 0xe3, 0x3a } };
+
+static cfg_int g_cfg_tuned_block_frames(g_cfg_tuned_block_frames_guid, 0);  // 0 = not tuned yet
+static cfg_int g_cfg_tuned_simd_convert(g_cfg_tuned_simd_convert_guid, 1);
+static cfg_int g_cfg_tuned_build(g_cfg_tuned_build_guid, 0);  // Build stamp of the stored result
+
+// Identifies this build, so a new build measures again
+static const int kBuildStamp = static_cast<int>(fnv1a_hash(__DATE__ " " __TIME__, sizeof(__DATE__ " " __TIME__)));
+
+static std::mutex g_tuning_mutex;     // Guards everything below except g_tuning_abort
+static std::thread g_tuning_thread;
+static bool g_tuning_running = false;
+static bool g_tuning_wanted = false;   // A measurement is due
+static bool g_tuning_shutdown = false;
+static bool g_playback_active = false;
+static std::atomic<bool> g_tuning_abort(false);
+
+struct tuning_params {
+    t_size block_frames;
+    bool simd_convert;
+};
+
+// Format and settings the candidates are measured with: stereo speech at
+// 44.1 kHz with nonlinear speedup, the most common heavy case
+static const unsigned kTuneSampleRate = 44100;
+static const unsigned kTuneChannels = 2;
+static const t_size kTuneFrames = 44100;
+static const int kTuneRuns = 5;  // Best of, to ride out scheduler noise
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Synthetic test signal: a gliding tone with pauses, so Speedy sees both
+// tense and relaxed frames
+static void make_tune_signal(std::vector<audio_sample>& out) {
+    out.resize(kTuneFrames * kTuneChannels);
+    double phase = 0.0;
+    for (t_size i = 0; i < kTuneFrames; i++) {
+        const double frequency = 120.0 + 80.0 * std::sin(i * 2e-4);
+        phase += 6.283185307179586 * frequency / kTuneSampleRate;
+        const double gate = ((i / 4410) % 4 == 3) ? 0.0 : 0.5;
+        for (unsigned c = 0; c < kTuneChannels; c++) {
+            out[i * kTuneChannels + c] = static_cast<audio_sample>(gate * std::sin(phase * (c + 1)));
+        }
+    }
+}
+
+// Time for both conversions over the test signal
+static double time_conversion(const std::vector<audio_sample>& signal, bool simd) {
+    std::vector<sonic_sample> converted(signal.size());
+    std::vector<audio_sample> restored(signal.size());
+    double best = 0.0;
+    for (int run = 0; run < kTuneRuns * 4; run++) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        convert_samples(signal.data(), converted.data(), signal.size(), simd);
+        convert_samples(converted.data(), restored.data(), signal.size(), simd);
+        const double elapsed = seconds_since(start);
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Time to run the test signal through the block pipeline with a block size
+static double time_block_size(const std::vector<audio_sample>& signal, t_size block_frames, bool simd) {
+    dsp_speedy_config config;
+    config.speed = 1.5f;
+    config.nonlinear_enabled = true;
+
+    std::vector<sonic_sample> input(block_frames * kTuneChannels);
+    std::vector<sonic_sample> output;
+    std::vector<audio_sample> restored;
+    double best = 0.0;
+    for (int run = 0; run < kTuneRuns; run++) {
+        sonicStream stream = create_stream(config, kTuneSampleRate, kTuneChannels);
+        if (!stream) {
+            return 0.0;
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (t_size offset = 0; offset < kTuneFrames; offset += block_frames) {
+            const t_size frames = std::min(block_frames, kTuneFrames - offset);
+            convert_samples(signal.data() + offset * kTuneChannels, input.data(), frames * kTuneChannels, simd);
+            sonic_io<sonic_sample>::write(stream, input.data(), static_cast<int>(frames));
+            const int available = sonicSamplesAvailable(stream);
+            if (available > 0) {
+                output.resize(static_cast<t_size>(available) * kTuneChannels);
+                restored.resize(output.size());
+                const int read = sonic_io<sonic_sample>::read(stream, output.data(), available);
+                if (read > 0) {
+                    convert_samples(output.data(), restored.data(), static_cast<t_size>(read) * kTuneChannels, simd);
+                }
+            }
+        }
+        const double elapsed = seconds_since(start);
+        sonicDestroyStream(stream);
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Measure all candidates and store the winners. Runs on g_tuning_thread.
+static void run_autotune() {
+    std::vector<audio_sample> signal;
+    make_tune_signal(signal);
+
+    tuning_params params;
+    params.simd_convert = time_conversion(signal, true) <= time_conversion(signal, false);
+
+    params.block_frames = kProcessBlockFrames;
+    double best = 0.0;
+    for (int i = 0; i < kBlockFrameCandidateCount && !g_tuning_abort; i++) {
+        const double elapsed = time_block_size(signal, kBlockFrameCandidates[i], params.simd_convert);
+        if (elapsed > 0.0 && (best == 0.0 || elapsed < best)) {
+            best = elapsed;
+            params.block_frames = kBlockFrameCandidates[i];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(g_tuning_mutex);
+    g_tuning_running = false;
+    if (g_tuning_abort) {
+        return;
+    }
+    g_tuning_wanted = false;
+    g_cfg_tuned_block_frames = static_cast<int>(params.block_frames);
+    g_cfg_tuned_simd_convert = params.simd_convert ? 1 : 0;
+    g_cfg_tuned_build = kBuildStamp;
+    console::printf("Speedy DSP: tuned for %u-frame blocks, %s sample conversion",
+        static_cast<unsigned>(params.block_frames), params.simd_convert ? "SSE2" : "scalar");
+}
+
+// Start a due measurement if nothing is playing and none is running.
+// Caller holds g_tuning_mutex.
+static void start_autotune_locked() {
+    if (!g_tuning_wanted || g_tuning_running || g_tuning_shutdown || g_playback_active) {
+        return;
+    }
+    if (g_tuning_thread.joinable()) {
+        g_tuning_thread.join();  // Previous measurement, already finished
+    }
+    g_tuning_abort = false;
+    g_tuning_running = true;
+    g_tuning_thread = std::thread(run_autotune);
+}
+
+// Whether the stored result exists and was measured by this build
+static bool tuning_is_current_locked() {
+    const t_size block_frames = static_cast<t_size>(static_cast<int>(g_cfg_tuned_block_frames));
+    for (int i = 0; i < kBlockFrameCandidateCount; i++) {
+        if (kBlockFrameCandidates[i] == block_frames) {
+            return static_cast<int>(g_cfg_tuned_build) == kBuildStamp;
+        }
+    }
+    return false;
+}
+
+// Stored tuning, or the defaults until the first measurement completes. A
+// missing or outdated result schedules a measurement for the next idle time.
+static tuning_params get_tuning() {
+    tuning_params params;
+    params.block_frames = kProcessBlockFrames;
+    params.simd_convert = false;
+
+    std::lock_guard<std::mutex> lock(g_tuning_mutex);
+    const t_size block_frames = static_cast<t_size>(static_cast<int>(g_cfg_tuned_block_frames));
+    for (int i = 0; i < kBlockFrameCandidateCount; i++) {
+        if (kBlockFrameCandidates[i] == block_frames) {
+            params.block_frames = block_frames;
+            params.simd_convert = static_cast<int>(g_cfg_tuned_simd_convert) != 0;
+            break;
+        }
+    }
+    if (!tuning_is_current_locked()) {
+        g_tuning_wanted = true;
+        start_autotune_locked();
+    }
+    return params;
+}
+
+static void retune() {
+    std::lock_guard<std::mutex> lock(g_tuning_mutex);
+    g_tuning_wanted = true;
+    start_autotune_locked();
+    if (!g_tuning_running) {
+        console::print("Speedy DSP: tuning deferred until playback stops");
+    }
+}
+
+// Playback state from play_callback: a measurement is abandoned when
+// playback starts and a due one starts when it stops
+static void set_playback_active(bool active) {
+    std::lock_guard<std::mutex> lock(g_tuning_mutex);
+    g_playback_active = active;
+    if (active) {
+        g_tuning_abort = true;  // Still wanted, so it runs again at the next stop
+    } else {
+        start_autotune_locked();
+    }
+}
+
+// Measure at startup if the stored result is missing or from another build
+static void init_autotune() {
+    std::lock_guard<std::mutex> lock(g_tuning_mutex);
+    if (!tuning_is_current_locked()) {
+        g_tuning_wanted = true;
+        start_autotune_locked();
+    }
+}
+
+// Stop a running measurement and wait for its thread
+static void finish_autotune() {
+    {
+        std::lock_guard<std::mutex> lock(g_tuning_mutex);
+        g_tuning_shutdown = true;
+        g_tuning_abort = true;
+    }
+    if (g_tuning_thread.joinable()) {
+        g_tuning_thread.join();
+    }
+}
+
+class speedy_play_callback : public play_callback_static {
+public:
+    unsigned get_flags() override {
+        return flag_on_playback_starting | flag_on_playback_stop;
+    }
+    void on_playback_starting(play_control::t_track_command, bool) override {
+        set_playback_active(true);
+    }
+    void on_playback_stop(play_control::t_stop_reason reason) override {
+        if (reason != play_control::stop_reason_starting_another) {
+            set_playback_active(false);
+        }
+    }
+    void on_playback_new_track(metadb_handle_ptr) override {}
+    void on_playback_seek(double) override {}
+    void on_playback_pause(bool) override {}
+    void on_playback_edited(metadb_handle_ptr) override {}
+    void on_playback_dynamic_info(const file_info&) override {}
+    void on_playback_dynamic_info_track(const file_info&) override {}
+    void on_playback_time(double) override {}
+    void on_volume_change(float) override {}
 };
 
+static play_callback_static_factory_t<speedy_play_callback> g_speedy_play_callback;
+
+// Start the reclamation worker with the application, so the playback thread
+// never creates it, and stop the workers at shutdown, while they can still
+// be joined safely (not from static destruction during DLL unload)
+class speedy_initquit : public initquit {
+public:
+    void on_init() override {
+        g_reclaimer.start();
+        init_autotune();
+    }
+    void on_quit() override {
+        finish_autotune();
+        g_reclaimer.shutdown();
+    }
+};
+
+static initquit_factory_t<speedy_initquit> g_speedy_initquit;
+
+
+// Denormal protection
+// Fade-outs and silent tails drive Speedy's spectral math and float paths into
+// denormal range, where x86 arithmetic slows down by an order of magnitude.
+// This sets flush-to-zero and denormals-are-zero for the current thread and
+// restores the caller's MXCSR on scope exit. Debug builds also clear the
+// denormal-operand and underflow flags on entry and, if either is raised on
+// exit, count the guarded call in *flag_count.
+class denormal_guard {
+public:
+    explicit denormal_guard(t_size* flag_count = nullptr) {
+#ifdef _DEBUG
+        m_flag_count = flag_count;
+#else
+        (void)flag_count;
+#endif
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+        m_saved_csr = _mm_getcsr();
+        unsigned csr = m_saved_csr | kFlushToZero | kDenormalsAreZero;
+#ifdef _DEBUG
+        csr &= ~kDenormalFlags;
+#endif
+        _mm_setcsr(csr);
+#endif
+    }
+
+    ~denormal_guard() {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#ifdef _DEBUG
+        if (m_flag_count && (_mm_getcsr() & kDenormalFlags) != 0) {
+            ++*m_flag_count;
+        }
+#endif
+        _mm_setcsr(m_saved_csr);
+#endif
+    }
+
+private:
+    static const unsigned kFlushToZero = 0x8000;
+    static const unsigned kDenormalsAreZero = 0x0040;
+    static const unsigned kDenormalFlags = _MM_EXCEPT_DENORM | _MM_EXCEPT_UNDERFLOW;
+    unsigned m_saved_csr = 0;
+#ifdef _DEBUG
+    t_size* m_flag_count;
+#endif
+
+    denormal_guard(const denormal_guard&) = delete;
+    denormal_guard& operator=(const denormal_guard&) = delete;
+};
+
+#ifdef _DEBUG
+// Debug builds count denormal samples written to the stream
+static t_size count_denormals(const audio_sample* samples, t_size count) {
+    t_size denormals = 0;
+    for (t_size i = 0; i < count; i++) {
+        if (std::fpclassify(samples[i]) == FP_SUBNORMAL) denormals++;
+    }
+    return denormals;
+}
+#endif
+
 // Forward declarations
 static void make_preset(const dsp_speedy_config& config, dsp_preset& out);
 static void parse_preset(const dsp_preset& preset, dsp_speedy_config& config);
 
 // DSP implementation class
-class dsp_speedy : public dsp_impl_base {
+class dsp_speedy : public dsp_v2 {
 public:
     dsp_speedy(const dsp_preset& preset) {
         parse_preset(preset, m_config);
+        m_settings_key = fnv1a_hash(preset.get_data(), preset.get_data_size());
         m_stream = nullptr;
         m_sample_rate = 0;
+        m_stream_rate = 0;
         m_channels = 0;
         m_channel_config = 0;
+        m_stream_fresh = false;
+        m_recording_snapshot = false;
+        m_input_frames = 0;
+        m_input_hash = kFnv1aBasis;
+        m_restore_frames = 0;
+        m_skip_frames = 0;
+        m_output_chunk_frames = 0;
+        m_prewarm_rate = 0;
+        m_prewarm_channels = 0;
+        m_block_frames = kProcessBlockFrames;
+        m_simd_convert = false;
+
+        // Build the stream for the most likely format off the playback thread
+        start_prewarm(static_cast<unsigned>(g_cfg_last_sample_rate),
+            static_cast<unsigned>(g_cfg_last_channels));
     }
 
     ~dsp_speedy() {
         cleanup_stream();
+        discard_prewarm();
+#ifdef _DEBUG
+        if (m_denormal_count > 0) {
+            console::printf("Speedy DSP: %u denormal input samples seen during processing",
+                static_cast<unsigned>(m_denormal_count));
+        }
+        if (m_denormal_flag_count > 0) {
+            console::printf("Speedy DSP: denormal or underflow flags raised in %u processing calls",
+                static_cast<unsigned>(m_denormal_flag_count));
+        }
+#endif
     }
 
     static GUID g_get_guid() {
@@ -123,163 +901,561 @@ public:
         return true;
     }
 
-    bool on_chunk(audio_chunk* chunk, abort_callback& abort) override {
-        if (m_config.is_default()) {
-            return true; // Pass through unchanged
+    // Runs over the whole pending chunk list rather than one chunk at a time:
+    // every chunk is fed to Sonic in turn, the input chunks are removed and
+    // the output is added back as chunks sized like the input, so no silence
+    // placeholders are needed while Sonic fills its buffers.
+    void run_v2(dsp_chunk_list* list, const metadb_handle_ptr& cur_file, int flags, abort_callback& abort) override {
+        m_cur_file = cur_file;
+        if (!m_config.is_default()) {
+            process_chunk_list(list);
         }
 
-        const t_size sample_count = chunk->get_sample_count();
-        const unsigned sample_rate = chunk->get_srate();
-        const unsigned channels = chunk->get_channels();
-        const unsigned channel_config = chunk->get_channel_config();
+        if (flags & dsp::FLUSH) {
+            flush_remaining(list);
+        }
+    }
 
-        // Check if format changed
-        if (sample_rate != m_sample_rate || channels != m_channels || channel_config != m_channel_config) {
-            cleanup_stream();
-            if (!init_stream(sample_rate, channels)) {
-                return true; // Pass through on error
-            }
-            m_sample_rate = sample_rate;
-            m_channels = channels;
-            m_channel_config = channel_config;
+    void flush() override {
+        cleanup_stream();
+        m_sample_rate = 0;
+        m_channels = 0;
+        m_channel_config = 0;
+    }
+
+    double get_latency() override {
+        // Return approximate latency in seconds
+        if (m_sample_rate > 0 && m_stream) {
+            // Sonic buffering plus, in nonlinear mode, Speedy's lookahead
+            // (kTemporalHysteresisFuture = 12 frames at 100Hz = 120ms), the
+            // resamplers and input still being collected
+            return get_profile_latency(get_latency_profile(m_config.latency_profile), m_config.use_speedy()) +
+                m_downsampler.get_latency() + m_upsampler.get_latency() +
+                static_cast<double>(m_pending_input.size() / m_channels) / m_sample_rate;
         }
+        return 0.0;
+    }
 
-        if (!m_stream) {
-            return true;
+    bool need_track_change_mark() override {
+        return false;
+    }
+
+private:
+    dsp_speedy_config m_config;
+    sonicStream m_stream;
+    unsigned m_sample_rate;
+    unsigned m_stream_rate;  // Rate Sonic runs at (below m_sample_rate in speech-bandwidth mode)
+    unsigned m_channels;
+    unsigned m_channel_config;
+
+    t_size m_block_frames;  // Processing block size, from the autotuner
+    bool m_simd_convert;    // SSE2 conversion kernels, from the autotuner
+
+    std::vector<sonic_sample> m_input_buffer;
+    std::vector<sonic_sample> m_output_buffer;
+    std::vector<audio_sample> m_pending_input;  // Small chunks collected up to kMinProcessFrames
+    std::vector<audio_sample> m_audio_output;  // Output pending for the chunk list
+    t_size m_output_chunk_frames;  // Largest input chunk of the current run
+    metadb_handle_ptr m_cur_file;
+
+    tension_estimator m_estimator;  // Low-power nonlinear speedup
+
+    // Speech-bandwidth mode
+    polyphase_resampler m_downsampler;
+    polyphase_resampler m_upsampler;
+    std::vector<audio_sample> m_band_input;   // Input at the internal rate
+    std::vector<audio_sample> m_band_output;  // Output at the internal rate
+
+#ifdef _DEBUG
+    t_size m_denormal_count = 0;       // Denormal input samples
+    t_size m_denormal_flag_count = 0;  // Guarded calls that raised DE or UE
+#endif
+
+    // Counter for denormal_guard (debug builds only)
+    t_size* denormal_flag_counter() {
+#ifdef _DEBUG
+        return &m_denormal_flag_count;
+#else
+        return nullptr;
+#endif
+    }
+
+    // Seek snapshots
+    // Sonic and Speedy keep their state in opaque structs, so instead of
+    // copying the stream we keep the output a fresh stream produced for a
+    // given start position, with a hash of the input it consumed. The key
+    // only covers the start of that input, so when the same start comes round
+    // again (a seek or A-B loop repeat) the snapshot is held until the new
+    // stream has consumed as much input. If that input matches, the part of
+    // the snapshot the new stream has not produced yet is played and the same
+    // number of frames is dropped from the new stream as it catches up.
+    t_uint64 m_settings_key;
+    seek_snapshot_cache::key m_snapshot_key;
+    seek_snapshot_cache::snapshot_ptr m_restore;  // Snapshot waiting for its input to match
+    seek_snapshot_cache::snapshot m_recording;    // Snapshot being recorded
+    bool m_stream_fresh;        // No chunk written since the stream was created
+    bool m_recording_snapshot;
+    t_size m_input_frames;      // Input consumed while recording or restoring
+    t_uint64 m_input_hash;      // Hash of that input
+    t_size m_restore_frames;    // New output produced while the restore is held
+    t_size m_skip_frames;       // Frames of new output already played from the snapshot
+
+    t_size seek_cache_budget() const {
+        int index = m_config.seek_cache_size;
+        if (index < 0 || index >= kSeekCacheSizeCount) index = kDefaultSeekCacheSize;
+        return static_cast<t_size>(kSeekCacheSizes[index]) * 1024 * 1024;
+    }
+
+    t_uint64 current_track_key() {
+        if (!m_cur_file.is_valid()) {
+            return 0;
         }
+        const char* path = m_cur_file->get_path();
+        const t_uint32 subsong = m_cur_file->get_subsong_index();
+        return fnv1a_hash(&subsong, sizeof(subsong), fnv1a_hash(path, strlen(path)));
+    }
 
-        // Get input samples
-        const audio_sample* input = chunk->get_data();
+    // Input frames needed to fingerprint the start of a fresh stream, or 0
+    // if it will not be fingerprinted
+    t_size fingerprint_frames(unsigned sample_rate) const {
+        if (!m_stream_fresh || seek_cache_budget() == 0) {
+            return 0;
+        }
+        return static_cast<t_size>(sample_rate * kFingerprintSeconds);
+    }
 
-        // Convert float samples to short for Sonic (with clamping)
-        m_input_buffer.resize(sample_count * channels);
-        for (t_size i = 0; i < sample_count * channels; i++) {
-            float sample = static_cast<float>(input[i]) * 32767.0f;
-            if (sample > 32767.0f) sample = 32767.0f;
-            if (sample < -32768.0f) sample = -32768.0f;
-            m_input_buffer[i] = static_cast<short>(sample);
+    // Look up the seek point starting with the given input, setting m_restore
+    // on a hit, or start recording a snapshot for it
+    void begin_snapshot(const audio_sample* input, t_size sample_count, unsigned sample_rate, unsigned channels) {
+        const t_size frames = fingerprint_frames(sample_rate);
+        m_stream_fresh = false;
+        m_recording_snapshot = false;
+        m_input_frames = 0;
+        m_input_hash = kFnv1aBasis;
+        m_restore_frames = 0;
+        m_skip_frames = 0;
+        m_restore.reset();
+        if (frames == 0 || sample_count < frames) {
+            return;
         }
 
-        // Write to Sonic stream
-        if (!sonicWriteShortToStream(m_stream, m_input_buffer.data(), static_cast<int>(sample_count))) {
-            return true; // Pass through on error
+        double peak = 0.0;
+        for (t_size i = 0; i < frames * channels; i++) {
+            peak = std::max(peak, std::fabs(static_cast<double>(input[i])));
+        }
+        if (peak < kFingerprintFloor) {
+            return;
         }
 
-        // Read all available processed samples
-        int max_samples = static_cast<int>(sample_count * 4); // Allow for slowdown
-        m_output_buffer.resize(max_samples * channels);
+        // Without a track the key would match other tracks' seek points
+        m_snapshot_key.track = current_track_key();
+        if (m_snapshot_key.track == 0) {
+            return;
+        }
+        m_snapshot_key.settings = m_settings_key;
+        m_snapshot_key.fingerprint = fnv1a_hash(input, frames * channels * sizeof(audio_sample));
+        m_snapshot_key.sample_rate = sample_rate;
+        m_snapshot_key.channels = channels;
+
+        m_restore = g_seek_cache.lookup(m_snapshot_key);
+        if (m_restore) {
+            return;
+        }
 
-        int total_read = 0;
-        int samples_read;
-        while ((samples_read = sonicReadShortFromStream(m_stream,
-                m_output_buffer.data() + total_read * channels,
-                max_samples - total_read)) > 0) {
-            total_read += samples_read;
-            if (total_read >= max_samples) break;
+        m_recording.output.clear();
+        m_recording_snapshot = true;
+    }
+
+    // Hash input about to be consumed while a snapshot is recorded, or up to
+    // the amount a held snapshot was recorded from
+    void track_snapshot_input(const audio_sample* input, t_size frames, unsigned channels) {
+        if (m_restore) {
+            frames = std::min(frames, m_restore->input_frames - m_input_frames);
+        } else if (!m_recording_snapshot) {
+            return;
         }
+        m_input_hash = fnv1a_hash(input, frames * channels * sizeof(audio_sample), m_input_hash);
+        m_input_frames += frames;
+    }
 
-        if (total_read > 0) {
-            // Convert short output back to audio_sample for foobar2000
-            m_audio_output.resize(total_read * channels);
-            for (int i = 0; i < total_read * static_cast<int>(channels); i++) {
-                m_audio_output[i] = static_cast<audio_sample>(m_output_buffer[i]) / 32767.0;
+    // Hands a recorded snapshot to the shared cache
+    void finish_snapshot() {
+        if (m_recording_snapshot) {
+            m_recording_snapshot = false;
+            m_recording.input_frames = m_input_frames;
+            m_recording.input_hash = m_input_hash;
+            g_seek_cache.store(m_snapshot_key, std::move(m_recording), seek_cache_budget());
+            m_recording.output = std::vector<sonic_sample>();
+        }
+    }
+
+    // All the input the held snapshot was recorded from has been consumed. If
+    // it matches, play the part of the snapshot the new stream has not
+    // produced yet; otherwise drop the snapshot.
+    void restore_snapshot(unsigned channels) {
+        const seek_snapshot_cache::snapshot_ptr snapshot = std::move(m_restore);
+        m_restore.reset();
+        if (m_input_hash != snapshot->input_hash) {
+            return;
+        }
+        const t_size frames = snapshot->output.size() / channels;
+        if (frames > m_restore_frames) {
+            m_skip_frames = frames - m_restore_frames;
+            append_output(snapshot->output.data() + m_restore_frames * channels, m_skip_frames, channels);
+        }
+    }
+
+    // Drops output already served from the snapshot, counts output produced
+    // while a snapshot is held, or records fresh output. Returns the resulting
+    // frame count.
+    int apply_snapshot(int frames, unsigned channels) {
+        if (m_skip_frames > 0 && frames > 0) {
+            const t_size skip = std::min(m_skip_frames, static_cast<t_size>(frames));
+            std::copy(m_output_buffer.begin() + skip * channels,
+                m_output_buffer.begin() + frames * channels,
+                m_output_buffer.begin());
+            frames -= static_cast<int>(skip);
+            m_skip_frames -= skip;
+        }
+
+        if (m_restore) {
+            m_restore_frames += frames;
+        } else if (m_recording_snapshot && frames > 0) {
+            const t_size limit = static_cast<t_size>(m_stream_rate * kSnapshotSeconds) * channels;
+            const t_size take = std::min(limit - m_recording.output.size(), static_cast<t_size>(frames) * channels);
+            m_recording.output.insert(m_recording.output.end(), m_output_buffer.begin(), m_output_buffer.begin() + take);
+            if (m_recording.output.size() >= limit) {
+                finish_snapshot();
             }
-            chunk->set_data(m_audio_output.data(), total_read, channels, sample_rate, channel_config);
-        } else {
-            // No output available yet - output silence
-            m_audio_output.resize(sample_count * channels);
-            std::fill(m_audio_output.begin(), m_audio_output.end(), static_cast<audio_sample>(0));
-            chunk->set_data(m_audio_output.data(), sample_count, channels, sample_rate, channel_config);
         }
 
+        return frames;
+    }
+
+    // Feed every chunk in the list through the stream. Chunks are consumed
+    // from the front and output is inserted in their place, so chunks that
+    // are passed through on error keep their position in the stream.
+    void process_chunk_list(dsp_chunk_list* list) {
+        denormal_guard no_denormals(denormal_flag_counter());
+
+        m_audio_output.clear();
+        m_output_chunk_frames = 0;
+        t_size index = 0;
+        while (index < list->get_count()) {
+            audio_chunk* chunk = list->get_item(index);
+            const t_size sample_count = chunk->get_sample_count();
+            const unsigned sample_rate = chunk->get_srate();
+            const unsigned channels = chunk->get_channels();
+            const unsigned channel_config = chunk->get_channel_config();
+
+            // Check if format changed
+            if (sample_rate != m_sample_rate || channels != m_channels || channel_config != m_channel_config) {
+                // Pending input and output belong to the old format
+                process_pending();
+                index = emit_output(list, index);
+                cleanup_stream();
+                m_sample_rate = 0;
+                m_channels = 0;
+                m_channel_config = 0;
+                if (!init_stream(sample_rate, channels)) {
+                    index++; // Pass through on error
+                    continue;
+                }
+                m_sample_rate = sample_rate;
+                m_channels = channels;
+                m_channel_config = channel_config;
+                g_cfg_last_sample_rate = sample_rate;
+                g_cfg_last_channels = channels;
+            }
+
+            if (!feed_chunk(chunk->get_data(), sample_count, sample_rate, channels)) {
+                index = emit_output(list, index);
+                index++; // Pass through on error
+                continue;
+            }
+            m_output_chunk_frames = std::max(m_output_chunk_frames, sample_count);
+            list->remove_by_idx(index);
+        }
+        emit_output(list, index);
+    }
+
+    // Feed one chunk to the stream, collecting chunks below the minimum block
+    // size first. Returns false if the chunk should be passed through unchanged.
+    bool feed_chunk(const audio_sample* input, t_size sample_count, unsigned sample_rate, unsigned channels) {
+        if (!m_stream) {
+            return false;
+        }
+
+        // The start of a fresh stream is collected until it can be fingerprinted
+        const t_size min_frames = std::max(kMinProcessFrames, fingerprint_frames(sample_rate));
+        if (m_pending_input.empty() && sample_count >= min_frames) {
+            return process_frames(input, sample_count, sample_rate, channels);
+        }
+
+        m_pending_input.insert(m_pending_input.end(), input, input + sample_count * channels);
+        if (m_pending_input.size() >= min_frames * channels) {
+            // The collected chunks are already gone from the list, so if Sonic
+            // rejects them they are dropped rather than passed through
+            process_pending();
+        }
         return true;
     }
 
-    void on_endofplayback(abort_callback& abort) override {
-        flush_remaining();
+    // Hand collected input to the stream
+    void process_pending() {
+        if (m_stream && !m_pending_input.empty()) {
+            process_frames(m_pending_input.data(), m_pending_input.size() / m_channels, m_sample_rate, m_channels);
+        }
+        m_pending_input.clear();
     }
 
-    void on_endoftrack(abort_callback& abort) override {
-        // Could flush here if needed, but usually better to keep stream continuous
+    // Run conversion, Sonic and conversion back one cache-sized block at a
+    // time so each sample stays resident across all stages. Returns false if
+    // nothing could be written.
+    bool process_frames(const audio_sample* input, t_size sample_count, unsigned sample_rate, unsigned channels) {
+        // First input of a new stream: check for a seek point we have seen before
+        if (m_stream_fresh) {
+            begin_snapshot(input, sample_count, sample_rate, channels);
+        }
+
+        for (t_size offset = 0; offset < sample_count; offset += m_block_frames) {
+            const t_size frames = std::min(m_block_frames, sample_count - offset);
+            const audio_sample* block = input + offset * channels;
+            track_snapshot_input(block, frames, channels);
+            if (!process_block(block, frames, sample_rate, channels)) {
+                return offset > 0;
+            }
+            if (m_restore && m_input_frames == m_restore->input_frames) {
+                restore_snapshot(channels);
+            }
+        }
+        return true;
     }
 
-    void flush() override {
-        cleanup_stream();
-        m_sample_rate = 0;
-        m_channels = 0;
-        m_channel_config = 0;
+    // Insert the pending output into the list at index, split into chunks no
+    // larger than the input chunks (or one processing block, if those were
+    // tiny). Returns the index after the last one.
+    t_size emit_output(dsp_chunk_list* list, t_size index) {
+        if (m_channels == 0 || m_audio_output.empty()) {
+            m_audio_output.clear();
+            return index;
+        }
+
+        const t_size total = m_audio_output.size() / m_channels;
+        const t_size chunk_frames = std::max(m_output_chunk_frames, m_block_frames);
+        for (t_size offset = 0; offset < total; offset += chunk_frames) {
+            const t_size frames = std::min(chunk_frames, total - offset);
+            audio_chunk* chunk = list->insert_item(index++, frames * m_channels);
+            chunk->set_data(m_audio_output.data() + offset * m_channels, frames, m_channels, m_sample_rate, m_channel_config);
+        }
+        m_audio_output.clear();
+        return index;
     }
 
-    double get_latency() override {
-        // Return approximate latency in seconds
-        if (m_sample_rate > 0 && m_stream) {
-            // Base Sonic latency
-            double latency = 0.02; // ~20ms typical latency
+    // Process one block of input and append the converted output to
+    // m_audio_output. Returns false if Sonic rejected the input.
+    bool process_block(const audio_sample* input, t_size frames, unsigned sample_rate, unsigned channels) {
+        // Speech-bandwidth mode: band-limit and downsample to the internal rate
+        if (m_downsampler.is_active()) {
+            m_band_input.clear();
+            m_downsampler.process(input, frames, m_band_input);
+            input = m_band_input.data();
+            frames = m_band_input.size() / channels;
+            if (frames == 0) {
+                return true;
+            }
+        }
 
-            // Speedy nonlinear mode adds significant lookahead latency
-            // kTemporalHysteresisFuture = 12 frames at 100Hz = 120ms
-            if (m_config.nonlinear_enabled) {
-                latency += 0.12; // ~120ms for Speedy lookahead
+        if (!write_block(input, frames, channels)) {
+            return false;
+        }
+        read_output(channels);
+        return true;
+    }
+
+    // Convert one block at Sonic's rate and write it to the stream
+    bool write_block(const audio_sample* input, t_size frames, unsigned channels) {
+        // Convert to Sonic's precision (with clamping)
+        m_input_buffer.resize(frames * channels);
+        convert_samples(input, m_input_buffer.data(), frames * channels, m_simd_convert);
+#ifdef _DEBUG
+        m_denormal_count += count_denormals(input, frames * channels);
+#endif
+
+        // Write to Sonic stream
+        if (m_config.use_low_power_nonlinear()) {
+            if (!write_with_tension(input, frames, channels)) {
+                return false;
             }
+        } else if (!sonic_io<sonic_sample>::write(m_stream, m_input_buffer.data(), static_cast<int>(frames))) {
+            return false;
+        }
+        return true;
+    }
 
-            return latency;
+    // Append everything Sonic has ready to m_audio_output, converted back
+    void read_output(unsigned channels) {
+        // Read all available processed samples in a single call. Every read
+        // that leaves samples behind makes Sonic memmove the rest of its output
+        // buffer to the front, which adds up to quadratic copying at slow speeds.
+        const int available = sonicSamplesAvailable(m_stream);
+        if (m_output_buffer.size() < static_cast<t_size>(available) * channels) {
+            m_output_buffer.resize(static_cast<t_size>(available) * channels);
         }
-        return 0.0;
+
+        int total_read = 0;
+        if (available > 0) {
+            total_read = sonic_io<sonic_sample>::read(m_stream, m_output_buffer.data(), available);
+            if (total_read < 0) total_read = 0;
+        }
+
+        total_read = apply_snapshot(total_read, channels);
+        append_output(m_output_buffer.data(), total_read, channels);
     }
 
-    bool need_track_change_mark() override {
-        return false;
+    // Convert stream output back to audio_sample for foobar2000 and append it
+    // to m_audio_output
+    void append_output(const sonic_sample* output, t_size frames, unsigned channels) {
+        if (m_upsampler.is_active()) {
+            m_band_output.resize(frames * channels);
+            convert_samples(output, m_band_output.data(), frames * channels, m_simd_convert);
+            m_upsampler.process(m_band_output.data(), frames, m_audio_output);
+        } else {
+            const t_size base = m_audio_output.size();
+            m_audio_output.resize(base + frames * channels);
+            convert_samples(output, m_audio_output.data() + base, frames * channels, m_simd_convert);
+        }
     }
 
-private:
-    dsp_speedy_config m_config;
-    sonicStream m_stream;
-    unsigned m_sample_rate;
-    unsigned m_channels;
-    unsigned m_channel_config;
+    // Low-power nonlinear speedup: write one analysis frame at a time, setting
+    // Sonic's speed from the time-domain tension of each completed frame once
+    // the whole frame is written. Speed changes then land on frame boundaries
+    // wherever the blocks split a frame, so the output does not depend on
+    // m_block_frames.
+    bool write_with_tension(const audio_sample* input, t_size frames, unsigned channels) {
+        t_size offset = 0;
+        while (offset < frames) {
+            const t_size count = std::min(frames - offset, m_estimator.frames_until_update());
+            const bool updated = m_estimator.accumulate(input + offset * channels, count, m_config.speed, m_config.nonlinear_factor);
+            if (!sonic_io<sonic_sample>::write(m_stream, m_input_buffer.data() + offset * channels, static_cast<int>(count))) {
+                return false;
+            }
+            if (updated) {
+                sonicSetSpeed(m_stream, m_estimator.speed());
+            }
+            offset += count;
+        }
+        return true;
+    }
 
-    std::vector<short> m_input_buffer;
-    std::vector<short> m_output_buffer;
-    std::vector<audio_sample> m_audio_output;
+    // Stream pre-warming
+    // sonicCreateStream and sonicEnableNonlinearSpeedup allocate Sonic's
+    // buffers and Speedy's FFT tables. A new instance builds its first stream
+    // on a worker thread for the last format seen, while the player is still
+    // opening the track, and the playback thread only picks up the result.
+    // After a seek the next chunk follows at once, so there is nothing to
+    // overlap with and the stream is created inline.
+    std::future<sonicStream> m_prewarm;
+    unsigned m_prewarm_rate;
+    unsigned m_prewarm_channels;
+
+    void start_prewarm(unsigned sample_rate, unsigned channels) {
+        discard_prewarm();
+        if (m_config.is_default() || sample_rate == 0 || channels == 0) {
+            return;
+        }
+        const dsp_speedy_config config = m_config;
+        const unsigned stream_rate = config.get_stream_rate(sample_rate);
+        m_prewarm_rate = stream_rate;
+        m_prewarm_channels = channels;
+        m_prewarm = std::async(std::launch::async, [config, stream_rate, channels]() {
+            return create_stream(config, stream_rate, channels);
+        });
+    }
+
+    // Returns the pre-warmed stream if it was built for the rate Sonic runs
+    // at and the channel count, else nullptr
+    sonicStream take_prewarmed_stream(unsigned stream_rate, unsigned channels) {
+        if (!m_prewarm.valid()) {
+            return nullptr;
+        }
+        sonicStream stream = m_prewarm.get();
+        if (stream && (stream_rate != m_prewarm_rate || channels != m_prewarm_channels)) {
+            g_reclaimer.retire(stream);
+            stream = nullptr;
+        }
+        return stream;
+    }
+
+    void discard_prewarm() {
+        g_reclaimer.retire(std::move(m_prewarm));
+        m_prewarm = std::future<sonicStream>();
+    }
 
     bool init_stream(unsigned sample_rate, unsigned channels) {
-        m_stream = sonicCreateStream(sample_rate, channels);
+        // Pick up the latest tuning; the first call starts the measurement
+        const tuning_params tuning = get_tuning();
+        m_block_frames = tuning.block_frames;
+        m_simd_convert = tuning.simd_convert;
+
+        // Speech-bandwidth mode: resample around Sonic. Rate pairs the
+        // resampler cannot handle run Sonic at the input rate instead.
+        m_stream_rate = m_config.get_stream_rate(sample_rate);
+        if (m_stream_rate == sample_rate ||
+            !m_downsampler.init(sample_rate, m_stream_rate, channels) ||
+            !m_upsampler.init(m_stream_rate, sample_rate, channels)) {
+            m_stream_rate = sample_rate;
+            m_downsampler.init(0, 0, 0);
+            m_upsampler.init(0, 0, 0);
+        }
+
+        m_stream = take_prewarmed_stream(m_stream_rate, channels);
+        if (!m_stream) {
+            m_stream = create_stream(m_config, m_stream_rate, channels);
+        }
         if (!m_stream) {
             return false;
         }
 
-        // Apply settings
-        // sonicSetSpeed and sonicSetRate are wrapped by sonic2.h (call internal sonic)
-        // sonicSetPitch and sonicSetVolume are renamed to Int versions by SONIC_INTERNAL
-        sonicSetSpeed(m_stream, m_config.speed);
-        sonicIntSetPitch(m_stream, m_config.pitch);
-        sonicSetRate(m_stream, m_config.rate);
-        sonicIntSetVolume(m_stream, m_config.volume);
-
-        // Enable nonlinear speedup if requested
-        if (m_config.nonlinear_enabled) {
-            sonicEnableNonlinearSpeedup(m_stream, m_config.nonlinear_factor);
-        }
+        m_estimator.init(m_stream_rate, channels);
 
+        m_stream_fresh = true;
         return true;
     }
 
     void cleanup_stream() {
-        if (m_stream) {
-            sonicDestroyStream(m_stream);
-            m_stream = nullptr;
-        }
+        g_reclaimer.retire(m_stream);
+        m_stream = nullptr;
+        m_pending_input.clear();
+        finish_snapshot();
+        m_restore.reset();
+        m_skip_frames = 0;
     }
 
-    void flush_remaining() {
+    // End of playback: run collected input through, drain Sonic and add the
+    // tail to the end of the chunk list
+    void flush_remaining(dsp_chunk_list* list) {
         if (m_stream) {
+            denormal_guard no_denormals(denormal_flag_counter());
+
+            process_pending();
+            // Output after a forced flush differs from the continuous stream
+            finish_snapshot();
+            m_restore.reset();
+
+            // Speech-bandwidth mode: the resamplers hold back their group
+            // delay, which has to be pushed through on either side of Sonic
+            if (m_downsampler.is_active()) {
+                m_band_input.clear();
+                m_downsampler.flush(m_band_input);
+                if (!m_band_input.empty()) {
+                    write_block(m_band_input.data(), m_band_input.size() / m_channels, m_channels);
+                }
+            }
             sonicFlushStream(m_stream);
-            // Read any remaining samples
-            m_output_buffer.resize(4096 * m_channels);
-            int samples_read;
-            do {
-                samples_read = sonicReadShortFromStream(m_stream, m_output_buffer.data(), 4096);
-            } while (samples_read > 0);
+            read_output(m_channels);
+            m_upsampler.flush(m_audio_output);
+            emit_output(list, list->get_count());
         }
     }
 };
@@ -296,6 +1472,11 @@ static void parse_preset(const dsp_preset& preset, dsp_speedy_config& config) {
 
         // Version 1: 5 floats + 1 bool (nonlinear_enabled)
         // Version 2: 5 floats + 2 bools (nonlinear_enabled, pitch_in_semitones)
+        // Version 3: version 2 + 1 byte (latency_profile)
+        // Version 4: version 3 + 1 byte (seek_cache_size)
+        // Version 5: version 4 + 1 byte (speech_band)
+        // Version 6: version 5 + 1 bool (low_power_nonlinear)
+        // Version 7: version 6 + 1 bool (low_memory, now ignored)
         if (size >= sizeof(float) * 5 + sizeof(bool)) {
             const float* floats = reinterpret_cast<const float*>(data);
             config.speed = floats[0];
@@ -311,6 +1492,43 @@ static void parse_preset(const dsp_preset& preset, dsp_speedy_config& config) {
             } else {
                 config.pitch_in_semitones = false;
             }
+
+            // Check for version 3 format with latency_profile
+            if (size >= sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8)) {
+                config.latency_profile = data[sizeof(float) * 5 + sizeof(bool) * 2];
+                if (config.latency_profile >= kLatencyProfileCount) {
+                    config.latency_profile = kDefaultLatencyProfile;
+                }
+            } else {
+                config.latency_profile = kDefaultLatencyProfile;
+            }
+
+            // Check for version 4 format with seek_cache_size
+            if (size >= sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8) * 2) {
+                config.seek_cache_size = data[sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8)];
+                if (config.seek_cache_size >= kSeekCacheSizeCount) {
+                    config.seek_cache_size = kDefaultSeekCacheSize;
+                }
+            } else {
+                config.seek_cache_size = kDefaultSeekCacheSize;
+            }
+
+            // Check for version 5 format with speech_band
+            if (size >= sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8) * 3) {
+                config.speech_band = data[sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8) * 2];
+                if (config.speech_band >= kSpeechBandRateCount) {
+                    config.speech_band = kDefaultSpeechBand;
+                }
+            } else {
+                config.speech_band = kDefaultSpeechBand;
+            }
+
+            // Check for version 6 format with low_power_nonlinear
+            if (size >= sizeof(float) * 5 + sizeof(bool) * 3 + sizeof(t_uint8) * 3) {
+                config.low_power_nonlinear = *reinterpret_cast<const bool*>(data + sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8) * 3);
+            } else {
+                config.low_power_nonlinear = kDefaultLowPowerNonlinear;
+            }
         } else {
             config.reset();
         }
@@ -322,8 +1540,8 @@ static void parse_preset(const dsp_preset& preset, dsp_speedy_config& config) {
 static void make_preset(const dsp_speedy_config& config, dsp_preset& out) {
     out.set_owner(g_dsp_speedy_guid);
 
-    // Binary format: 5 floats + 2 bools
-    std::vector<char> data(sizeof(float) * 5 + sizeof(bool) * 2);
+    // Binary format: 5 floats + 2 bools + 3 bytes + 1 bool
+    std::vector<char> data(sizeof(float) * 5 + sizeof(bool) * 3 + sizeof(t_uint8) * 3);
     float* floats = reinterpret_cast<float*>(data.data());
     floats[0] = config.speed;
     floats[1] = config.pitch;
@@ -332,6 +1550,10 @@ static void make_preset(const dsp_speedy_config& config, dsp_preset& out) {
     floats[4] = config.nonlinear_factor;
     *reinterpret_cast<bool*>(data.data() + sizeof(float) * 5) = config.nonlinear_enabled;
     *reinterpret_cast<bool*>(data.data() + sizeof(float) * 5 + sizeof(bool)) = config.pitch_in_semitones;
+    data[sizeof(float) * 5 + sizeof(bool) * 2] = static_cast<char>(config.latency_profile);
+    data[sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8)] = static_cast<char>(config.seek_cache_size);
+    data[sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8) * 2] = static_cast<char>(config.speech_band);
+    *reinterpret_cast<bool*>(data.data() + sizeof(float) * 5 + sizeof(bool) * 2 + sizeof(t_uint8) * 3) = config.low_power_nonlinear;
 
     out.set_data(data.data(), data.size());
 }
@@ -381,6 +1603,69 @@ static void UpdatePitchSliderForMode(HWND hDlg, DialogData* data) {
     }
 }
 
+// Fill the latency profile combo box, showing the latency each profile reports
+static void InitLatencyProfileCombo(HWND hDlg, const dsp_speedy_config& config) {
+    SendDlgItemMessageA(hDlg, IDC_LATENCY_PROFILE, CB_RESETCONTENT, 0, 0);
+    for (int i = 0; i < kLatencyProfileCount; i++) {
+        const latency_profile_params& profile = kLatencyProfiles[i];
+        char buf[64];
+        if (config.low_power_nonlinear) {
+            // The low-power estimator replaces Speedy and has no lookahead,
+            // so every profile runs at Sonic's own latency
+            snprintf(buf, sizeof(buf), "%s (~%d ms, low-power, %s pitch search)", profile.name,
+                static_cast<int>(get_profile_latency(profile, false) * 1000.0 + 0.5),
+                profile.sonic_quality ? "full-rate" : "decimated");
+        } else if (profile.speedy_lookahead_frames > 0) {
+            // Profiles with the same lookahead differ only in the pitch search
+            snprintf(buf, sizeof(buf), "%s (~%d ms, %s pitch search)", profile.name,
+                static_cast<int>(get_profile_latency(profile, true) * 1000.0 + 0.5),
+                profile.sonic_quality ? "full-rate" : "decimated");
+        } else {
+            snprintf(buf, sizeof(buf), "%s (~%d ms, linear only)", profile.name,
+                static_cast<int>(get_profile_latency(profile, false) * 1000.0 + 0.5));
+        }
+        SendDlgItemMessageA(hDlg, IDC_LATENCY_PROFILE, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(buf));
+    }
+    SendDlgItemMessageA(hDlg, IDC_LATENCY_PROFILE, CB_SETCURSEL, config.latency_profile, 0);
+}
+
+// Fill the seek cache size combo box
+static void InitSeekCacheCombo(HWND hDlg, const dsp_speedy_config& config) {
+    SendDlgItemMessageA(hDlg, IDC_SEEK_CACHE, CB_RESETCONTENT, 0, 0);
+    for (int i = 0; i < kSeekCacheSizeCount; i++) {
+        char buf[32];
+        if (kSeekCacheSizes[i] > 0) {
+            snprintf(buf, sizeof(buf), "%d MB", kSeekCacheSizes[i]);
+        } else {
+            snprintf(buf, sizeof(buf), "Off");
+        }
+        SendDlgItemMessageA(hDlg, IDC_SEEK_CACHE, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(buf));
+    }
+    SendDlgItemMessageA(hDlg, IDC_SEEK_CACHE, CB_SETCURSEL, config.seek_cache_size, 0);
+}
+
+// Fill the speech-bandwidth mode combo box
+static void InitSpeechBandCombo(HWND hDlg, const dsp_speedy_config& config) {
+    SendDlgItemMessageA(hDlg, IDC_SPEECH_BAND, CB_RESETCONTENT, 0, 0);
+    for (int i = 0; i < kSpeechBandRateCount; i++) {
+        char buf[32];
+        if (kSpeechBandRates[i] > 0) {
+            snprintf(buf, sizeof(buf), "%u kHz", kSpeechBandRates[i] / 1000);
+        } else {
+            snprintf(buf, sizeof(buf), "Off (full band)");
+        }
+        SendDlgItemMessageA(hDlg, IDC_SPEECH_BAND, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(buf));
+    }
+    SendDlgItemMessageA(hDlg, IDC_SPEECH_BAND, CB_SETCURSEL, config.speech_band, 0);
+}
+
+// The live profile has no Speedy lookahead, so nonlinear speedup there needs
+// the low-power estimator
+static void UpdateNonlinearEnabled(HWND hDlg, const dsp_speedy_config& config) {
+    EnableWindow(GetDlgItem(hDlg, IDC_NONLINEAR),
+        config.low_power_nonlinear || get_latency_profile(config.latency_profile).speedy_lookahead_frames > 0);
+}
+
 static void UpdatePresetFromDialog(HWND hDlg, DialogData* data) {
     dsp_preset_impl preset;
     make_preset(data->config, preset);
@@ -410,6 +1695,17 @@ static INT_PTR CALLBACK DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARA
 
             // Initialize nonlinear checkbox
             CheckDlgButton(hDlg, IDC_NONLINEAR, data->config.nonlinear_enabled ? BST_CHECKED : BST_UNCHECKED);
+            CheckDlgButton(hDlg, IDC_LOW_POWER, data->config.low_power_nonlinear ? BST_CHECKED : BST_UNCHECKED);
+
+            // Initialize latency profile selector
+            InitLatencyProfileCombo(hDlg, data->config);
+            UpdateNonlinearEnabled(hDlg, data->config);
+
+            // Initialize seek cache size selector
+            InitSeekCacheCombo(hDlg, data->config);
+
+            // Initialize speech-bandwidth mode selector
+            InitSpeechBandCombo(hDlg, data->config);
 
             UpdateDialogLabels(hDlg, data->config);
             return TRUE;
@@ -459,6 +1755,52 @@ static INT_PTR CALLBACK DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARA
             }
             return TRUE;
 
+        case IDC_LOW_POWER:
+            if (data && HIWORD(wParam) == BN_CLICKED) {
+                data->config.low_power_nonlinear = (IsDlgButtonChecked(hDlg, IDC_LOW_POWER) == BST_CHECKED);
+                UpdateNonlinearEnabled(hDlg, data->config);
+                InitLatencyProfileCombo(hDlg, data->config);
+                UpdatePresetFromDialog(hDlg, data);
+            }
+            return TRUE;
+
+        case IDC_LATENCY_PROFILE:
+            if (data && HIWORD(wParam) == CBN_SELCHANGE) {
+                int sel = static_cast<int>(SendDlgItemMessageA(hDlg, IDC_LATENCY_PROFILE, CB_GETCURSEL, 0, 0));
+                if (sel >= 0 && sel < kLatencyProfileCount) {
+                    data->config.latency_profile = sel;
+                    UpdateNonlinearEnabled(hDlg, data->config);
+                    UpdatePresetFromDialog(hDlg, data);
+                }
+            }
+            return TRUE;
+
+        case IDC_SEEK_CACHE:
+            if (data && HIWORD(wParam) == CBN_SELCHANGE) {
+                int sel = static_cast<int>(SendDlgItemMessageA(hDlg, IDC_SEEK_CACHE, CB_GETCURSEL, 0, 0));
+                if (sel >= 0 && sel < kSeekCacheSizeCount) {
+                    data->config.seek_cache_size = sel;
+                    UpdatePresetFromDialog(hDlg, data);
+                }
+            }
+            return TRUE;
+
+        case IDC_SPEECH_BAND:
+            if (data && HIWORD(wParam) == CBN_SELCHANGE) {
+                int sel = static_cast<int>(SendDlgItemMessageA(hDlg, IDC_SPEECH_BAND, CB_GETCURSEL, 0, 0));
+                if (sel >= 0 && sel < kSpeechBandRateCount) {
+                    data->config.speech_band = sel;
+                    UpdatePresetFromDialog(hDlg, data);
+                }
+            }
+            return TRUE;
+
+        case IDC_RETUNE:
+            if (HIWORD(wParam) == BN_CLICKED) {
+                retune();
+            }
+            return TRUE;
+
         case IDC_RESET:
             if (data) {
                 data->config.reset();
@@ -471,6 +1813,11 @@ static INT_PTR CALLBACK DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARA
                 UpdatePitchSliderForMode(hDlg, data);
 
                 CheckDlgButton(hDlg, IDC_NONLINEAR, BST_UNCHECKED);
+                CheckDlgButton(hDlg, IDC_LOW_POWER, BST_UNCHECKED);
+                InitLatencyProfileCombo(hDlg, data->config);
+                UpdateNonlinearEnabled(hDlg, data->config);
+                SendDlgItemMessageA(hDlg, IDC_SEEK_CACHE, CB_SETCURSEL, data->config.seek_cache_size, 0);
+                SendDlgItemMessageA(hDlg, IDC_SPEECH_BAND, CB_SETCURSEL, data->config.speech_band, 0);
 
                 UpdateDialogLabels(hDlg, data->config);
                 UpdatePresetFromDialog(hDlg, data);
@@ -0,0 +1,133 @@
+/*
+ * resampler.cpp - Streaming polyphase resampler
+ */
+
+#include "pch.h"
+#include "resampler.h"
+#include <cmath>
+#include <emmintrin.h>
+
+// Largest number of phases (reduced output-rate factor) supported. Covers
+// every pair of the common 8-192 kHz rates, e.g. 44100 -> 16000 is 160/441.
+static const size_t kMaxPhases = 1024;
+
+// Taps per phase when upsampling; downsampling widens this by the ratio so the
+// anti-alias filter keeps the same transition band relative to the output rate
+static const size_t kBaseTaps = 32;
+
+// Passband edge as a fraction of the lower Nyquist frequency
+static const double kRolloff = 0.9;
+
+static const double kPi = 3.14159265358979323846;
+
+static size_t gcd(size_t a, size_t b) {
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+polyphase_resampler::polyphase_resampler() :
+    m_channels(0),
+    m_in_rate(0),
+    m_phases(0),
+    m_step(0),
+    m_taps(0),
+    m_phase(0),
+    m_position(0)
+{}
+
+bool polyphase_resampler::init(unsigned in_rate, unsigned out_rate, unsigned channels) {
+    m_phases = 0;
+    m_table.clear();
+    m_history.clear();
+    if (in_rate == 0 || out_rate == 0 || channels == 0 || in_rate == out_rate) {
+        return false;
+    }
+
+    const size_t divisor = gcd(in_rate, out_rate);
+    const size_t phases = out_rate / divisor;
+    const size_t step = in_rate / divisor;
+    if (phases > kMaxPhases) {
+        return false;
+    }
+
+    // Cutoff in cycles per input sample, below the lower of the two Nyquists
+    const double ratio = static_cast<double>(out_rate) / in_rate;
+    const double cutoff = 0.5 * kRolloff * (ratio < 1.0 ? ratio : 1.0);
+
+    size_t taps = kBaseTaps;
+    if (ratio < 1.0) {
+        taps = static_cast<size_t>(std::ceil(kBaseTaps / ratio));
+    }
+    taps = (taps + 3) & ~static_cast<size_t>(3);  // Multiple of 4 for SSE
+
+    // Windowed-sinc prototype sampled at each phase offset. Tap k of phase p
+    // sits at (center - k + p / phases) input samples from the output time.
+    const double center = taps / 2 - 1;
+    const double half_width = taps / 2.0;
+    m_table.resize(phases * taps);
+    for (size_t p = 0; p < phases; p++) {
+        float* coefficients = &m_table[p * taps];
+        double sum = 0.0;
+        for (size_t k = 0; k < taps; k++) {
+            const double t = center - static_cast<double>(k) + static_cast<double>(p) / phases;
+            const double x = 2.0 * cutoff * t;
+            const double sinc = (std::fabs(x) < 1e-12) ? 1.0 : std::sin(kPi * x) / (kPi * x);
+            double window = 0.0;
+            if (std::fabs(t) <= half_width) {
+                // Blackman window
+                const double w = kPi * t / half_width;
+                window = 0.42 + 0.5 * std::cos(w) + 0.08 * std::cos(2.0 * w);
+            }
+            const double h = 2.0 * cutoff * sinc * window;
+            coefficients[k] = static_cast<float>(h);
+            sum += h;
+        }
+        // Unity gain at DC for every phase
+        for (size_t k = 0; k < taps; k++) {
+            coefficients[k] = static_cast<float>(coefficients[k] / sum);
+        }
+    }
+
+    m_channels = channels;
+    m_in_rate = in_rate;
+    m_phases = phases;
+    m_step = step;
+    m_taps = taps;
+    m_history.resize(channels);
+    reset();
+    return true;
+}
+
+void polyphase_resampler::reset() {
+    // Prime with zeros so the first output frame lines up with the first input
+    m_phase = 0;
+    m_position = 0;
+    for (unsigned c = 0; c < m_history.size(); c++) {
+        m_history[c].assign(m_taps / 2 - 1, 0.0f);
+    }
+}
+
+double polyphase_resampler::get_latency() const {
+    if (!is_active()) {
+        return 0.0;
+    }
+    return static_cast<double>(m_taps / 2) / m_in_rate;
+}
+
+float polyphase_resampler::dot_product(const float* a, const float* b, size_t count) {
+    // count is a multiple of 4
+    __m128 acc = _mm_setzero_ps();
+    for (size_t i = 0; i < count; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    // Horizontal sum
+    __m128 shuffled = _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(acc, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
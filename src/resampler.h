@@ -0,0 +1,86 @@
+/*
+ * resampler.h - Streaming polyphase resampler
+ *
+ * Used by the speech-bandwidth mode to run Sonic and Speedy at a reduced
+ * internal rate. The ratio between rates is reduced to L/M and a windowed-sinc
+ * prototype is split into L phases, so each output frame is one dot product
+ * over the channel's history. History is kept planar so the dot products run
+ * over contiguous memory with SSE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class polyphase_resampler {
+public:
+    polyphase_resampler();
+
+    // Set up for the given rates. Returns false (and stays inactive) if the
+    // rates are equal or their reduced ratio needs too many phases.
+    bool init(unsigned in_rate, unsigned out_rate, unsigned channels);
+
+    // Drop all history, as after a seek
+    void reset();
+
+    // Push the history still held back (the group delay) out to the output,
+    // at the end of the stream
+    template<typename T>
+    void flush(std::vector<T>& out) {
+        if (!is_active()) return;
+        const std::vector<T> silence((m_taps / 2) * m_channels, static_cast<T>(0));
+        process(silence.data(), m_taps / 2, out);
+    }
+
+    bool is_active() const { return m_phases > 0; }
+
+    // Group delay in seconds
+    double get_latency() const;
+
+    // Resample interleaved input and append interleaved output to out
+    template<typename T>
+    void process(const T* in, size_t frames, std::vector<T>& out) {
+        if (frames == 0) return;
+        for (unsigned c = 0; c < m_channels; c++) {
+            std::vector<float>& history = m_history[c];
+            const size_t base = history.size();
+            history.resize(base + frames);
+            for (size_t i = 0; i < frames; i++) {
+                history[base + i] = static_cast<float>(in[i * m_channels + c]);
+            }
+        }
+
+        const size_t available = m_history[0].size();
+        while (m_position + m_taps <= available) {
+            const float* phase = &m_table[m_phase * m_taps];
+            for (unsigned c = 0; c < m_channels; c++) {
+                out.push_back(static_cast<T>(dot_product(&m_history[c][m_position], phase, m_taps)));
+            }
+            m_phase += m_step;
+            m_position += m_phase / m_phases;
+            m_phase %= m_phases;
+        }
+
+        // Discard history no longer needed by any future output frame
+        if (m_position > 0) {
+            for (unsigned c = 0; c < m_channels; c++) {
+                m_history[c].erase(m_history[c].begin(), m_history[c].begin() + m_position);
+            }
+            m_position = 0;
+        }
+    }
+
+private:
+    static float dot_product(const float* a, const float* b, size_t count);
+
+    unsigned m_channels;
+    unsigned m_in_rate;
+    size_t m_phases;    // L: output frames per M input frames
+    size_t m_step;      // M: input advance per L output frames
+    size_t m_taps;      // Taps per phase
+    size_t m_phase;     // Current phase (0..L-1)
+    size_t m_position;  // First history frame used by the next output frame
+    std::vector<float> m_table;                 // m_phases x m_taps coefficients
+    std::vector<std::vector<float> > m_history; // Per-channel input history
+};
@@ -13,13 +13,21 @@
 #define IDC_STATIC_PITCH                1008
 #define IDC_PITCH_MODE_RATIO            1009
 #define IDC_PITCH_MODE_SEMITONES        1010
+#define IDC_LATENCY_PROFILE             1011
+#define IDC_STATIC_LATENCY              1012
+#define IDC_SEEK_CACHE                  1013
+#define IDC_STATIC_SEEK_CACHE           1014
+#define IDC_SPEECH_BAND                 1015
+#define IDC_STATIC_SPEECH_BAND          1016
+#define IDC_LOW_POWER                   1017
+#define IDC_RETUNE                      1019
 
 // Next default values for new objects
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        102
 #define _APS_NEXT_COMMAND_VALUE         40001
-#define _APS_NEXT_CONTROL_VALUE         1011
+#define _APS_NEXT_CONTROL_VALUE         1020
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
@@ -0,0 +1,156 @@
+/*
+ * sample_convert.h - Sample format conversion for the processing core
+ *
+ * Converts between foobar2000's audio_sample (float or double depending on
+ * the SDK build) and the precision handed to Sonic (16-bit integer or float).
+ * Each combination is an explicit specialization so the hot loops run in the
+ * precision of their operands, without implicit float <-> double promotion.
+ *
+ * float <-> int16 also has explicit SSE2 kernels that give the same results
+ * as the scalar loops; which of the two is used is decided by the autotuner.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <emmintrin.h>
+
+template<typename In, typename Out>
+struct sample_converter;
+
+// float -> int16 with clamping
+template<>
+struct sample_converter<float, short> {
+    static void convert(const float* in, short* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            float sample = in[i] * 32767.0f;
+            if (sample > 32767.0f) sample = 32767.0f;
+            if (sample < -32768.0f) sample = -32768.0f;
+            out[i] = static_cast<short>(sample);
+        }
+    }
+};
+
+// double -> int16 with clamping
+template<>
+struct sample_converter<double, short> {
+    static void convert(const double* in, short* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            double sample = in[i] * 32767.0;
+            if (sample > 32767.0) sample = 32767.0;
+            if (sample < -32768.0) sample = -32768.0;
+            out[i] = static_cast<short>(sample);
+        }
+    }
+};
+
+// int16 -> float
+template<>
+struct sample_converter<short, float> {
+    static void convert(const short* in, float* out, size_t count) {
+        const float scale = 1.0f / 32767.0f;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = static_cast<float>(in[i]) * scale;
+        }
+    }
+};
+
+// int16 -> double
+template<>
+struct sample_converter<short, double> {
+    static void convert(const short* in, double* out, size_t count) {
+        const double scale = 1.0 / 32767.0;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = static_cast<double>(in[i]) * scale;
+        }
+    }
+};
+
+// float -> float (Sonic clamps float input itself)
+template<>
+struct sample_converter<float, float> {
+    static void convert(const float* in, float* out, size_t count) {
+        memcpy(out, in, count * sizeof(float));
+    }
+};
+
+// double -> float
+template<>
+struct sample_converter<double, float> {
+    static void convert(const double* in, float* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = static_cast<float>(in[i]);
+        }
+    }
+};
+
+// float -> double
+template<>
+struct sample_converter<float, double> {
+    static void convert(const float* in, double* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = static_cast<double>(in[i]);
+        }
+    }
+};
+
+template<typename In, typename Out>
+inline void convert_samples(const In* in, Out* out, size_t count) {
+    sample_converter<In, Out>::convert(in, out, count);
+}
+
+// float -> int16, 8 samples at a time with the scalar version's scaling,
+// clamping and truncation
+inline void convert_float_to_short_sse2(const float* in, short* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+        a = _mm_max_ps(_mm_min_ps(a, high), low);
+        b = _mm_max_ps(_mm_min_ps(b, high), low);
+        const __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    sample_converter<float, short>::convert(in + i, out + i, count - i);
+}
+
+// int16 -> float, 8 samples at a time
+inline void convert_short_to_float_sse2(const short* in, float* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by unpacking into the high halves and shifting back down
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+    sample_converter<short, float>::convert(in + i, out + i, count - i);
+}
+
+// Conversion using the SIMD kernel where one exists and simd is set
+template<typename In, typename Out>
+inline void convert_samples(const In* in, Out* out, size_t count, bool simd) {
+    convert_samples(in, out, count);
+}
+
+inline void convert_samples(const float* in, short* out, size_t count, bool simd) {
+    if (simd) {
+        convert_float_to_short_sse2(in, out, count);
+    } else {
+        convert_samples(in, out, count);
+    }
+}
+
+inline void convert_samples(const short* in, float* out, size_t count, bool simd) {
+    if (simd) {
+        convert_short_to_float_sse2(in, out, count);
+    } else {
+        convert_samples(in, out, count);
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * tension_estimator.h - Low-power nonlinear speedup
+ *
+ * Approximates Speedy's per-frame tension from time-domain features instead
+ * of FFT spectra: the energy envelope (onsets are tense, silence is not), the
+ * zero-crossing rate and a short-term spectral tilt taken from the energy of
+ * the first difference (fricatives and bursts are tense, steady vowels less
+ * so). Each 10 ms frame costs a few multiply-adds per sample.
+ *
+ * The tension is turned into a per-frame speed around the target speed, with
+ * a running duration feedback so the long-term average stays at the target.
+ * There is no lookahead, so unlike Speedy it adds no latency.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+class tension_estimator {
+public:
+    tension_estimator() : m_channels(0), m_frame_frames(0) { reset(); }
+
+    void init(unsigned sample_rate, unsigned channels) {
+        m_channels = channels;
+        m_frame_frames = sample_rate / 100;  // 10 ms, Speedy's hop
+        if (m_frame_frames == 0) m_frame_frames = 1;
+        reset();
+    }
+
+    void reset() {
+        m_energy = 0.0f;
+        m_diff_energy = 0.0f;
+        m_crossings = 0;
+        m_count = 0;
+        m_prev_sample = 0.0f;
+        m_prev_level_db = -100.0f;
+        m_floor_db = -60.0f;
+        m_tension = 0.0f;
+        m_mean_weight = 1.0f;
+        m_speed = 1.0f;
+    }
+
+    // Frames left before the current analysis frame completes
+    size_t frames_until_update() const { return m_frame_frames - m_count; }
+
+    // Speed for the most recently completed frame
+    float speed() const { return m_speed; }
+
+    // Accumulate interleaved samples, at most frames_until_update() of them.
+    // Returns true when a frame completed and speed() was updated.
+    template<typename T>
+    bool accumulate(const T* in, size_t frames, float target_speed, float nonlinear_factor) {
+        float prev = m_prev_sample;
+        for (size_t i = 0; i < frames; i++) {
+            float sample = 0.0f;
+            for (unsigned c = 0; c < m_channels; c++) {
+                sample += static_cast<float>(in[i * m_channels + c]);
+            }
+            sample /= static_cast<float>(m_channels);
+            const float diff = sample - prev;
+            m_energy += sample * sample;
+            m_diff_energy += diff * diff;
+            if ((sample >= 0.0f) != (prev >= 0.0f)) m_crossings++;
+            prev = sample;
+        }
+        m_prev_sample = prev;
+        m_count += frames;
+
+        if (m_count < m_frame_frames) {
+            return false;
+        }
+
+        const float tension = finish_frame();
+
+        // Tense frames move towards 1x, relaxed ones take up the difference
+        float weight = 1.0f - nonlinear_factor * tension;
+        if (weight < 0.0f) weight = 0.0f;
+        m_mean_weight += kFeedbackRate * (weight - m_mean_weight);
+        const float mean = m_mean_weight > kMinMeanWeight ? m_mean_weight : kMinMeanWeight;
+
+        m_speed = 1.0f + (target_speed - 1.0f) * weight / mean;
+        if (m_speed < kMinSpeed) m_speed = kMinSpeed;
+        if (m_speed > kMaxSpeed) m_speed = kMaxSpeed;
+        return true;
+    }
+
+private:
+    static constexpr float kFeedbackRate = 0.005f;   // Per frame, ~2 s time constant
+    static constexpr float kMinMeanWeight = 0.1f;
+    static constexpr float kReleasePerFrame = 0.8f;  // ~50 ms tension release
+    static constexpr float kMinSpeed = 0.25f;
+    static constexpr float kMaxSpeed = 4.0f;
+
+    // Turn the accumulated features of a frame into a tension in [0, 1]
+    float finish_frame() {
+        const float energy = m_energy / m_count;
+        const float diff_energy = m_diff_energy / m_count;
+        const float zcr = static_cast<float>(m_crossings) / m_count;
+        m_energy = 0.0f;
+        m_diff_energy = 0.0f;
+        m_crossings = 0;
+        m_count = 0;
+
+        const float level_db = 10.0f * std::log10(energy + 1e-10f);
+        const float tilt = diff_energy / (energy + 1e-10f);  // 0 (low-pass) .. 4 (high-pass)
+
+        // Slowly rising minimum tracks the noise floor
+        if (level_db < m_floor_db) {
+            m_floor_db = level_db;
+        } else {
+            m_floor_db += 0.05f;
+        }
+
+        float raw;
+        if (level_db < m_floor_db + 6.0f) {
+            raw = 0.0f;  // Silence or pause: compress most
+        } else {
+            // Onsets (rising energy) are the tensest part of speech
+            float onset = (level_db - m_prev_level_db) / 10.0f;
+            onset = onset < 0.0f ? 0.0f : (onset > 1.0f ? 1.0f : onset);
+
+            // High tilt and zero-crossing rate mark fricatives and bursts
+            float brightness = 0.5f * (tilt - 0.5f) / 1.5f + 0.5f * (zcr - 0.05f) / 0.25f;
+            brightness = brightness < 0.0f ? 0.0f : (brightness > 1.0f ? 1.0f : brightness);
+
+            raw = 0.3f + 0.3f * brightness;
+            if (onset > raw) raw = onset;
+        }
+        m_prev_level_db = level_db;
+
+        // Fast attack, short release, standing in for Speedy's hysteresis
+        if (raw > m_tension) {
+            m_tension = raw;
+        } else {
+            m_tension = m_tension * kReleasePerFrame + raw * (1.0f - kReleasePerFrame);
+        }
+        return m_tension;
+    }
+
+    unsigned m_channels;
+    size_t m_frame_frames;
+
+    // Features of the frame being accumulated (mono mix)
+    float m_energy;
+    float m_diff_energy;
+    size_t m_crossings;
+    size_t m_count;
+    float m_prev_sample;
+
+    float m_prev_level_db;
+    float m_floor_db;
+    float m_tension;
+    float m_mean_weight;
+    float m_speed;
+};